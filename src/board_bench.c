@@ -0,0 +1,145 @@
+// Placement and shot throughput of the bitboard path against the generic grid
+// path, calling the server's packet handlers in-process.
+//
+// Build: gcc -O2 -o board_bench board_bench.c
+// Usage: ./board_bench [iterations]
+#define HW4_NO_MAIN
+#include "hw4.c"
+
+#include <fcntl.h>
+#include <time.h>
+
+#define BOARD_WIDTH 10
+#define BOARD_HEIGHT 10
+
+// Same layout as scripts/p1_Win
+const char *placement = "I 1 1 0 0 1 1 0 2 1 1 0 4 1 1 2 2 1 1 2 0";
+
+double seconds_since(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Put the player back to its freshly placed state
+void reset_player(GameBoard *board, PlayerState *player, TetrisPiece pieces[5]) {
+    for (int i = 0; i < board->height; i++) {
+        memset(board->grid[i], 'E', board->width);
+        memset(player->hits[i], 'E', board->width);
+    }
+    memcpy(player->pieces, pieces, sizeof(player->pieces));
+    player->ships_remaining = 5;
+    player->hit_mask = 0;
+
+    // Mark the ships on the board so shots can hit them
+    for (int i = 0; i < 5; i++) {
+        int (*offsets)[2] = shape_offsets[pieces[i].type - 1][pieces[i].rotation - 1];
+        for (int j = 0; j < 4; j++) {
+            board->grid[pieces[i].row + offsets[j][0]][pieces[i].column + offsets[j][1]] = 'S';
+        }
+    }
+}
+
+// Check every piece mask against the cells shape_offsets gives, at every position
+// where the piece fits; the bitboard path is only worth timing if it is right
+int masks_match_offsets(GameBoard *board) {
+    for (int t = 0; t < 7; t++) {
+        for (int r = 0; r < 4; r++) {
+            int (*offsets)[2] = shape_offsets[t][r];
+            for (int row = -3; row < board->height + 3; row++) {
+                for (int col = -3; col < board->width + 3; col++) {
+                    TetrisPiece piece = {t + 1, r + 1, col, row};
+                    if (!does_piece_fit(board, piece)) continue;
+
+                    BoardMask expected = 0;
+                    for (int i = 0; i < 4; i++) {
+                        expected |= (BoardMask)1 << ((row + offsets[i][0]) * board->width + col + offsets[i][1]);
+                    }
+                    if (piece_mask(board, piece) != expected) return 0;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+// Time placement and shots on one board; responses are hashed so both paths can be compared
+void run(GameBoard *board, PlayerState *player, int iterations,
+         double *placement_ns, double *shot_ns, unsigned long *checksum) {
+    char packet[BUFFER_SIZE], response[BUFFER_SIZE];
+    char shots[BOARD_WIDTH * BOARD_HEIGHT][16];
+    struct timespec start;
+
+    *checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int n = 0; n < iterations; n++) {
+        memset(player->pieces, 0, sizeof(player->pieces));
+        strcpy(packet, placement);
+        *checksum += process_initialize_packet(board, player, packet);
+    }
+    *placement_ns = seconds_since(&start) * 1e9 / iterations;
+
+    TetrisPiece pieces[5];
+    memcpy(pieces, player->pieces, sizeof(pieces));
+    for (int cell = 0; cell < BOARD_WIDTH * BOARD_HEIGHT; cell++) {
+        snprintf(shots[cell], sizeof(shots[cell]), "S %d %d", cell / BOARD_WIDTH, cell % BOARD_WIDTH);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int n = 0; n < iterations; n++) {
+        reset_player(board, player, pieces);
+        for (int cell = 0; cell < BOARD_WIDTH * BOARD_HEIGHT; cell++) {
+            *checksum = *checksum * 31 + process_shoot_packet(board, player, shots[cell], response);
+            *checksum = *checksum * 31 + response[2] + response[strlen(response) - 1];
+        }
+        // Shooting a cell twice exercises the already-guessed check
+        *checksum = *checksum * 31 + process_shoot_packet(board, player, shots[0], response);
+    }
+    *shot_ns = seconds_since(&start) * 1e9 / (iterations * (BOARD_WIDTH * BOARD_HEIGHT + 1.0));
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+    if (iterations < 1) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // The packet handlers log every piece; keep that out of the terminal
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    double placement_ns[2], shot_ns[2];
+    unsigned long checksum[2];
+    for (int fast = 1; fast >= 0; fast--) {
+        GameBoard *board = initialize_board(BOARD_WIDTH, BOARD_HEIGHT);
+        PlayerState *player = initialize_player_state(BOARD_WIDTH, BOARD_HEIGHT);
+        if (fast && !board->is_fast) {
+            fprintf(stderr, "[Bench] Bitboard path unavailable for %dx%d.\n", BOARD_WIDTH, BOARD_HEIGHT);
+            exit(EXIT_FAILURE);
+        }
+        if (fast && !masks_match_offsets(board)) {
+            fprintf(stderr, "[Bench] Bitboard masks disagree with shape_offsets.\n");
+            exit(EXIT_FAILURE);
+        }
+        board->is_fast = fast;
+        run(board, player, iterations, &placement_ns[fast], &shot_ns[fast], &checksum[fast]);
+    }
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    printf("%-10s %14s %14s\n", "Path", "Placement ns", "Shot ns");
+    printf("%-10s %14.1f %14.1f\n", "generic", placement_ns[0], shot_ns[0]);
+    printf("%-10s %14.1f %14.1f\n", "bitboard", placement_ns[1], shot_ns[1]);
+    printf("Speedup    %13.2fx %13.2fx\n", placement_ns[0] / placement_ns[1], shot_ns[0] / shot_ns[1]);
+
+    if (checksum[0] != checksum[1]) {
+        fprintf(stderr, "[Bench] Bitboard and generic paths gave different results.\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
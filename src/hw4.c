@@ -1,14 +1,132 @@
+#define _GNU_SOURCE // struct ucred for SO_PEERCRED
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <time.h>
+#include <signal.h>
 #include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
 
 #define PORT1 2201
 #define PORT2 2202
+#define SOCKET_PATH1 "/tmp/hw4_player1.sock" // Unix domain socket for co-located Player 1
+#define SOCKET_PATH2 "/tmp/hw4_player2.sock" // Unix domain socket for co-located Player 2
+#define UPGRADE_PATH "/tmp/hw4_upgrade.sock" // A new server connects here to take over the match
+#define HANDOFF_FDS 6 // TCP listeners, Unix listeners, and both clients
+#define HANDOFF_MAGIC 0x48573448u // "HW4H", opens the hello and the header
+#define HANDOFF_PROTOCOL_VERSION 1 // Order of messages on the upgrade socket
+#define HANDOFF_FORMAT_VERSION 2 // Layout of the serialized match state
+#define HANDOFF_RESUMED 0x52534d44u // "RSMD", the new server's ack once it owns the match
+#define HANDOFF_TIMEOUT_MS 2000 // Longest wait for each handoff message
 #define BUFFER_SIZE 1024
+#define FAST_BOARD_CELLS 128 // Boards up to this many cells use the bitboard path
+#define FAST_MAX_WIDTH 12 // Widest such board, since Begin requires a height of at least 10
+
+#include "shm_ring.h"
+
+typedef unsigned __int128 BoardMask; // One bit per cell, bit index = row * width + col
+
+// Per-packet tracing. Build with -DTRACE to record spans around each stage of
+// packet handling; send SIGUSR1 to write them to TRACE_PATH as a Chrome trace.
+#ifdef TRACE
+#include <x86intrin.h>
+
+#define TRACE_CAPACITY 65536     // Spans kept; the oldest are overwritten
+#define TRACE_SAMPLE_RATE 16     // Trace one packet in this many
+#define TRACE_PATH "/tmp/hw4_trace.json"
+
+typedef struct {
+    const char *name;
+    unsigned long long start; // rdtsc ticks
+    unsigned long long end;
+    int player;
+} TraceSpan;
+
+// The server is single-threaded, so one buffer serves as the per-thread buffer
+TraceSpan trace_spans[TRACE_CAPACITY];
+unsigned long trace_count = 0;   // Total spans recorded
+unsigned long trace_packets = 0; // Total packets seen, for sampling
+int trace_sampled = 0;           // 1 if the current packet is being traced
+unsigned long long trace_tsc_base; // rdtsc and CLOCK_MONOTONIC at startup, to convert ticks to us
+struct timespec trace_clock_base;
+volatile sig_atomic_t trace_dump_requested = 0;
+
+void trace_record(const char *name, unsigned long long start, int player) {
+    TraceSpan *span = &trace_spans[trace_count++ % TRACE_CAPACITY];
+    span->name = name;
+    span->start = start;
+    span->end = __rdtsc();
+    span->player = player;
+}
+
+void trace_request_dump(int signal_number) {
+    (void)signal_number;
+    trace_dump_requested = 1;
+}
+
+void trace_init() {
+    struct sigaction action = {0};
+    action.sa_handler = trace_request_dump;
+    // poll() fails with EINTR regardless, which wakes the main loop to export;
+    // SA_RESTART keeps the signal from failing sends and handoff transfers
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+    trace_tsc_base = __rdtsc();
+    clock_gettime(CLOCK_MONOTONIC, &trace_clock_base);
+}
+
+// Write the buffered spans to TRACE_PATH in Chrome/Perfetto JSON format
+void trace_export() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed_us = (now.tv_sec - trace_clock_base.tv_sec) * 1e6 +
+                        (now.tv_nsec - trace_clock_base.tv_nsec) / 1e3;
+    double ticks_per_us = (__rdtsc() - trace_tsc_base) / elapsed_us;
+
+    FILE *file = fopen(TRACE_PATH, "w");
+    if (!file) {
+        perror("[Server] Trace export failed");
+        return;
+    }
+
+    unsigned long first = trace_count > TRACE_CAPACITY ? trace_count - TRACE_CAPACITY : 0;
+    fprintf(file, "{\"traceEvents\":[");
+    for (unsigned long i = first; i < trace_count; i++) {
+        TraceSpan *span = &trace_spans[i % TRACE_CAPACITY];
+        fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                i == first ? "" : ",", span->name,
+                (span->start - trace_tsc_base) / ticks_per_us,
+                (span->end - span->start) / ticks_per_us, (int)getpid(), span->player);
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    printf("[Server] Wrote %lu trace spans to %s\n", trace_count - first, TRACE_PATH);
+}
+
+#define TRACE_INIT() trace_init()
+#define TRACE_PACKET() (trace_sampled = (trace_packets++ % TRACE_SAMPLE_RATE == 0))
+#define TRACE_DECLARE(var) unsigned long long var = 0
+#define TRACE_BEGIN(var) (var = trace_sampled ? __rdtsc() : 0)
+#define TRACE_END(var, name, player) do { if (var) { trace_record(name, var, player); var = 0; } } while (0)
+#define TRACE_DECLARE_PLAYER(var) int var = 0
+#define TRACE_SET_PLAYER(var, player) (var = (player))
+#define TRACE_EXPORT_IF_REQUESTED() do { if (trace_dump_requested) { trace_dump_requested = 0; trace_export(); } } while (0)
+#else
+#define TRACE_INIT()
+#define TRACE_PACKET()
+#define TRACE_DECLARE(var)
+#define TRACE_BEGIN(var)
+#define TRACE_END(var, name, player)
+#define TRACE_DECLARE_PLAYER(var)
+#define TRACE_SET_PLAYER(var, player)
+#define TRACE_EXPORT_IF_REQUESTED()
+#endif
 
 // Define the phases of the game
 typedef enum {
@@ -69,6 +187,7 @@ typedef struct {
     int width;
     int height;
     char **grid; // 2D grid: 'E' for empty, 'S' for ship, 'H' for hit, 'M' for miss
+    int is_fast; // 1 if the board fits in a BoardMask and has a shape_masks table
 } GameBoard;
 
 typedef struct {
@@ -85,14 +204,99 @@ typedef struct {
     int ships_remaining;     // Number of ships left
     TetrisPiece pieces[5];   // Array of 5 pieces
     char **hits;             // 2D array to track hits/misses
+    BoardMask hit_mask;      // Cells guessed as hits, for sunk checks (fast boards only)
 } PlayerState;
 
+// First message from a new server on the upgrade socket
+typedef struct {
+    uint32_t magic;
+    uint32_t protocol_version;
+    uint32_t format_version;  // State format the new server can read
+} HandoffHello;
+
+// Match state sent from the old server to the new one during a hot restart
+typedef struct {
+    uint32_t magic;
+    uint32_t format_version;
+    int width;
+    int height;
+    int player_ready[2];
+    PlayerPhase phases[2];
+    int next_player;         // Player whose packet the server is waiting for
+    int has_board;           // 1 once both players have sent Begin
+    int shm_players[2];      // 1 if the player talks over its shared-memory segment
+} HandoffHeader;
+
+// Shared-memory segments for each player, and the client fd of players attached to them
+ShmChannel *shm_channels[2] = {NULL, NULL};
+int shm_fds[2] = {-1, -1};
+
+
+// Smallest and largest row/col offset of each piece: {min_row, min_col, max_row, max_col}
+int shape_bounds[7][4][4];
+int shape_bounds_ready = 0;
+
+// Piece masks for each fast board width, anchored at the piece's smallest row/col offset
+BoardMask shape_masks[FAST_MAX_WIDTH + 1][7][4];
+int shape_masks_ready[FAST_MAX_WIDTH + 1] = {0};
+
+// Compute shape_bounds from shape_offsets; the table never changes, so this only runs once
+void initialize_shape_bounds() {
+    if (shape_bounds_ready) return;
+    shape_bounds_ready = 1;
+
+    for (int t = 0; t < 7; t++) {
+        for (int r = 0; r < 4; r++) {
+            int (*offsets)[2] = shape_offsets[t][r];
+            int *bounds = shape_bounds[t][r];
+            bounds[0] = bounds[2] = offsets[0][0];
+            bounds[1] = bounds[3] = offsets[0][1];
+            for (int i = 1; i < 4; i++) {
+                if (offsets[i][0] < bounds[0]) bounds[0] = offsets[i][0];
+                if (offsets[i][1] < bounds[1]) bounds[1] = offsets[i][1];
+                if (offsets[i][0] > bounds[2]) bounds[2] = offsets[i][0];
+                if (offsets[i][1] > bounds[3]) bounds[3] = offsets[i][1];
+            }
+        }
+    }
+}
+
+// Build the piece masks for boards of the given width; each width is only built once
+void initialize_shape_masks(int width) {
+    if (shape_masks_ready[width]) return;
+    shape_masks_ready[width] = 1;
+
+    for (int t = 0; t < 7; t++) {
+        for (int r = 0; r < 4; r++) {
+            int (*offsets)[2] = shape_offsets[t][r];
+            int *bounds = shape_bounds[t][r];
+            BoardMask mask = 0;
+            for (int i = 0; i < 4; i++) {
+                int bit = (offsets[i][0] - bounds[0]) * width + (offsets[i][1] - bounds[1]);
+                mask |= (BoardMask)1 << bit;
+            }
+            shape_masks[width][t][r] = mask;
+        }
+    }
+}
+
+// Mask of the cells covered by a piece that is known to fit on a fast board
+BoardMask piece_mask(GameBoard *board, TetrisPiece piece) {
+    int *bounds = shape_bounds[piece.type - 1][piece.rotation - 1];
+    int shift = (piece.row + bounds[0]) * board->width + (piece.column + bounds[1]);
+    return shape_masks[board->width][piece.type - 1][piece.rotation - 1] << shift;
+}
 
 // Initialize the game board
 GameBoard *initialize_board(int width, int height) {
     GameBoard *board = malloc(sizeof(GameBoard));
     board->width = width;
     board->height = height;
+    board->is_fast = (width <= FAST_MAX_WIDTH && (long long)width * height <= FAST_BOARD_CELLS);
+    if (board->is_fast) {
+        initialize_shape_bounds();
+        initialize_shape_masks(width);
+    }
 
     board->grid = malloc(height * sizeof(char *));
     for (int i = 0; i < height; i++) {
@@ -108,6 +312,8 @@ PlayerState *initialize_player_state(int width, int height) {
     PlayerState *player = malloc(sizeof(PlayerState));
     player->is_ready = 0;
     player->ships_remaining = 5;
+    memset(player->pieces, 0, sizeof(player->pieces));
+    player->hit_mask = 0;
 
     player->hits = malloc(height * sizeof(char *));
     for (int i = 0; i < height; i++) {
@@ -143,18 +349,111 @@ void free_player_state(PlayerState *player, int height) {
     printf("[Debug] Player state freed.\n");
 }
 
+// Shared-memory channel of the player on client_fd, or NULL for socket players
+ShmChannel *shm_channel_for(int client_fd) {
+    for (int i = 0; i < 2; i++) {
+        if (shm_fds[i] >= 0 && shm_fds[i] == client_fd) return shm_channels[i];
+    }
+    return NULL;
+}
+
+// Whether the process on the other end of an accepted Unix socket is the one that
+// claimed the segment. The claim is cleared either way, so it is only honoured once.
+int shm_claimed_by(ShmChannel *channel, int client_fd) {
+    struct sockaddr_storage local;
+    socklen_t local_len = sizeof(local);
+    struct ucred peer;
+    socklen_t peer_len = sizeof(peer);
+    uint32_t claim = atomic_exchange(&channel->client_pid, 0);
+
+    if (claim == 0 || getsockname(client_fd, (struct sockaddr *)&local, &local_len) < 0 ||
+        local.ss_family != AF_UNIX) {
+        return 0;
+    }
+    if (getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) < 0) {
+        return 0;
+    }
+    return peer.pid == (pid_t)claim;
+}
+
+// Send a packet to a player over whichever transport it connected with
+void send_packet(int client_fd, const char *packet) {
+    ShmChannel *channel = shm_channel_for(client_fd);
+    if (channel) {
+        shm_ring_push(&channel->to_client, packet, strlen(packet));
+    } else {
+        send(client_fd, packet, strlen(packet), 0);
+    }
+}
+
+// Read the next packet from a player; returns its length like read()
+ssize_t receive_packet(int client_fd, char *buffer, size_t size) {
+    ShmChannel *channel = shm_channel_for(client_fd);
+    if (channel) {
+        return shm_ring_pop(&channel->to_server, buffer, size);
+    }
+    return read(client_fd, buffer, size);
+}
+
+// Wait until the player has a packet or a new server connects to take over.
+// Returns 1 for a packet, 0 for a takeover, and -1 with errno set on failure.
+int wait_for_packet(int client_fd, int upgrade_fd) {
+    ShmChannel *channel = shm_channel_for(client_fd);
+    struct pollfd fds[2] = {
+        {.fd = client_fd, .events = POLLIN},
+        {.fd = upgrade_fd, .events = POLLIN}
+    };
+
+    if (!channel) {
+        if (poll(fds, 2, -1) < 0) return -1;
+        return (fds[1].revents & POLLIN) ? 0 : 1;
+    }
+
+    // Check for a takeover or the client hanging up at least every SHM_POLL_MS, even
+    // when packets keep arriving, without paying for a poll() on every packet
+    static struct timespec last_check;
+    while (1) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((now.tv_sec - last_check.tv_sec) * 1000 + (now.tv_nsec - last_check.tv_nsec) / 1000000 >= SHM_POLL_MS) {
+            last_check = now;
+            if (poll(fds, 2, 0) < 0) return -1;
+            if (fds[1].revents & POLLIN) return 0;
+            if (fds[0].revents & (POLLIN | POLLHUP)) return 1; // The read then returns 0
+        }
+
+        int ready = shm_ring_wait(&channel->to_server, SHM_POLL_MS);
+        if (ready != 0) return ready;
+    }
+}
+
+// Remove the socket files and shared-memory segments before the server exits
+void remove_server_files() {
+    unlink(SOCKET_PATH1);
+    unlink(SOCKET_PATH2);
+    unlink(UPGRADE_PATH);
+    shm_unlink(SHM_PATH1);
+    shm_unlink(SHM_PATH2);
+}
+
 // Function to send error response
 void send_error(int client_fd, int error_code, int player_num) {
     char error_message[BUFFER_SIZE];
     snprintf(error_message, BUFFER_SIZE, "E %d", error_code);
-    send(client_fd, error_message, strlen(error_message), 0);
+    TRACE_DECLARE(send_start);
+    TRACE_BEGIN(send_start);
+    send_packet(client_fd, error_message);
+    TRACE_END(send_start, "send", player_num);
     printf("[Server] Sent to Player %d: E %d.\n", player_num, error_code);
 }
 
 
 // Function to send acknowledgment
 void send_acknowledgment(int client_fd, int player_num) {
-    send(client_fd, "A", strlen("A"), 0);
+    TRACE_DECLARE(send_start);
+    TRACE_BEGIN(send_start);
+    send_packet(client_fd, "A");
+    TRACE_END(send_start, "send", player_num);
     printf("[Server] Sent acknowledgment to Player %d.\n", player_num);
 }
 
@@ -162,12 +461,12 @@ void send_acknowledgment(int client_fd, int player_num) {
 // Function to process Forfeit packet
 void process_forfeit_packet(int forfeiting_player, int client_fd1, int client_fd2, GameBoard *game_board, PlayerState *player1, PlayerState *player2) {
     if (forfeiting_player == 1) {
-        send(client_fd1, "H 0", strlen("H 0"), 0); // Player 1 loses
-        send(client_fd2, "H 1", strlen("H 1"), 0); // Player 2 wins
+        send_packet(client_fd1, "H 0"); // Player 1 loses
+        send_packet(client_fd2, "H 1"); // Player 2 wins
         printf("[Server] Player 1 forfeited. Player 2 wins.\n");
     } else if (forfeiting_player == 2) {
-        send(client_fd1, "H 1", strlen("H 1"), 0); // Player 1 wins
-        send(client_fd2, "H 0", strlen("H 0"), 0); // Player 2 loses
+        send_packet(client_fd1, "H 1"); // Player 1 wins
+        send_packet(client_fd2, "H 0"); // Player 2 loses
         printf("[Server] Player 2 forfeited. Player 1 wins.\n");
     }
 
@@ -197,11 +496,283 @@ void process_forfeit_packet(int forfeiting_player, int client_fd1, int client_fd
         close(client_fd2);
     }
 
+    remove_server_files();
     printf("[Debug] Cleanup complete. Exiting.\n");
     exit(0); // Terminate server
 }
 
+// Create a listening Unix domain socket at the given path
+int create_unix_listener(const char *path) {
+    struct sockaddr_un address;
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    unlink(path); // Remove a stale socket file left by a previous run
+
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(server_fd, 3) < 0) {
+        close(server_fd);
+        return -1;
+    }
+
+    return server_fd;
+}
+
+// Accept a player on whichever of its TCP or Unix listeners connects first
+int accept_player(int tcp_fd, int unix_fd) {
+    struct pollfd fds[2] = {
+        {.fd = tcp_fd, .events = POLLIN},
+        {.fd = unix_fd, .events = POLLIN}
+    };
+
+    if (poll(fds, 2, -1) < 0) {
+        return -1;
+    }
+
+    if (fds[1].revents & POLLIN) {
+        return accept(unix_fd, NULL, NULL);
+    }
+    return accept(tcp_fd, NULL, NULL);
+}
+
+// Write or read exactly len bytes, retrying on short transfers
+int transfer_all(int fd, void *data, size_t len, int sending) {
+    char *cursor = data;
+    while (len > 0) {
+        ssize_t n = sending ? send(fd, cursor, len, MSG_NOSIGNAL) : recv(fd, cursor, len, 0);
+        if (n <= 0) {
+            if (n == 0) errno = ECONNRESET; // Peer went away mid-message
+            return -1;
+        }
+        cursor += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Bound every read and write on the upgrade connection by HANDOFF_TIMEOUT_MS
+void set_handoff_timeout(int fd) {
+    struct timeval timeout = {HANDOFF_TIMEOUT_MS / 1000, (HANDOFF_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+// Send a player's state field by field, followed by the rows of its hits grid
+int send_player_state(int fd, PlayerState *player, int width, int height) {
+    int32_t fields[2 + 5 * 4];
+    uint64_t masks[2];
+
+    fields[0] = player->is_ready;
+    fields[1] = player->ships_remaining;
+    for (int i = 0; i < 5; i++) {
+        fields[2 + i * 4] = player->pieces[i].type;
+        fields[3 + i * 4] = player->pieces[i].rotation;
+        fields[4 + i * 4] = player->pieces[i].column;
+        fields[5 + i * 4] = player->pieces[i].row;
+    }
+    masks[0] = (uint64_t)player->hit_mask;
+    masks[1] = (uint64_t)(player->hit_mask >> 64);
+
+    if (transfer_all(fd, fields, sizeof(fields), 1) < 0) return -1;
+    if (transfer_all(fd, masks, sizeof(masks), 1) < 0) return -1;
+    for (int i = 0; i < height; i++) {
+        if (transfer_all(fd, player->hits[i], width, 1) < 0) return -1;
+    }
+    return 0;
+}
+
+// Receive a player's state into one allocated by initialize_player_state
+int receive_player_state(int fd, PlayerState *player, int width, int height) {
+    int32_t fields[2 + 5 * 4];
+    uint64_t masks[2];
+
+    if (transfer_all(fd, fields, sizeof(fields), 0) < 0) return -1;
+    if (transfer_all(fd, masks, sizeof(masks), 0) < 0) return -1;
+    for (int i = 0; i < height; i++) {
+        if (transfer_all(fd, player->hits[i], width, 0) < 0) return -1;
+    }
+
+    player->is_ready = fields[0];
+    player->ships_remaining = fields[1];
+    for (int i = 0; i < 5; i++) {
+        player->pieces[i].type = fields[2 + i * 4];
+        player->pieces[i].rotation = fields[3 + i * 4];
+        player->pieces[i].column = fields[4 + i * 4];
+        player->pieces[i].row = fields[5 + i * 4];
+    }
+    player->hit_mask = (BoardMask)masks[1] << 64 | masks[0];
+    return 0;
+}
+
+// Hand the listening sockets, both clients and the match state to a new server.
+// The peer must run as the same user and say hello with a matching magic number and
+// versions before anything is sent. Returns 0 only once the new server has acked that
+// it resumed the match; on -1 (errno set) the caller still owns the match.
+int send_handoff(int control_fd, int fds[HANDOFF_FDS], HandoffHeader *header,
+                 GameBoard *board, PlayerState *player1, PlayerState *player2) {
+    struct ucred peer;
+    socklen_t peer_len = sizeof(peer);
+    HandoffHello hello;
+    uint32_t ack;
+
+    set_handoff_timeout(control_fd);
+    if (getsockopt(control_fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) < 0) {
+        return -1;
+    }
+    if (peer.uid != getuid()) {
+        printf("[Server] Rejected takeover from uid %d.\n", (int)peer.uid);
+        errno = EPERM;
+        return -1;
+    }
+
+    if (transfer_all(control_fd, &hello, sizeof(hello), 0) < 0) {
+        return -1;
+    }
+    if (hello.magic != HANDOFF_MAGIC || hello.protocol_version != HANDOFF_PROTOCOL_VERSION ||
+        hello.format_version != HANDOFF_FORMAT_VERSION) {
+        printf("[Server] Rejected takeover: protocol %u, format %u (expected %d, %d).\n",
+               hello.protocol_version, hello.format_version,
+               HANDOFF_PROTOCOL_VERSION, HANDOFF_FORMAT_VERSION);
+        errno = EPROTO;
+        return -1;
+    }
+
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_FDS)];
+    struct iovec iov = {.iov_base = header, .iov_len = sizeof(HandoffHeader)};
+    struct msghdr message = {0};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * HANDOFF_FDS);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * HANDOFF_FDS);
+
+    if (sendmsg(control_fd, &message, MSG_NOSIGNAL) != sizeof(HandoffHeader)) {
+        return -1;
+    }
+
+    if (header->has_board) {
+        for (int i = 0; i < board->height; i++) {
+            if (transfer_all(control_fd, board->grid[i], board->width, 1) < 0) return -1;
+        }
+        if (send_player_state(control_fd, player1, board->width, board->height) < 0 ||
+            send_player_state(control_fd, player2, board->width, board->height) < 0) {
+            return -1;
+        }
+    }
+
+    // The new server only starts serving after it acks, so until then the match is ours
+    if (transfer_all(control_fd, &ack, sizeof(ack), 0) < 0) {
+        return -1;
+    }
+    if (ack != HANDOFF_RESUMED) {
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+// Take over a running match from the old server listening on UPGRADE_PATH.
+// Returns the upgrade connection, which confirm_handoff must ack once the new
+// server is ready to serve, or -1 with errno set.
+int receive_handoff(int fds[HANDOFF_FDS], HandoffHeader *header,
+                    GameBoard **board, PlayerState **player1, PlayerState **player2) {
+    struct sockaddr_un address;
+    int control_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (control_fd < 0) {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, UPGRADE_PATH, sizeof(address.sun_path) - 1);
+    if (connect(control_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(control_fd);
+        return -1;
+    }
+    set_handoff_timeout(control_fd);
+
+    HandoffHello hello = {HANDOFF_MAGIC, HANDOFF_PROTOCOL_VERSION, HANDOFF_FORMAT_VERSION};
+    if (transfer_all(control_fd, &hello, sizeof(hello), 1) < 0) {
+        close(control_fd);
+        return -1;
+    }
+
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_FDS)];
+    struct iovec iov = {.iov_base = header, .iov_len = sizeof(HandoffHeader)};
+    struct msghdr message = {0};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    // A rejected hello just closes the connection, so this read sees EOF
+    ssize_t received = recvmsg(control_fd, &message, MSG_WAITALL);
+    if (received != sizeof(HandoffHeader)) {
+        if (received >= 0) errno = ECONNRESET;
+        close(control_fd);
+        return -1;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int) * HANDOFF_FDS)) {
+        errno = EPROTO;
+        close(control_fd);
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * HANDOFF_FDS);
+
+    if (header->magic != HANDOFF_MAGIC || header->format_version != HANDOFF_FORMAT_VERSION) {
+        errno = EPROTO;
+        close(control_fd);
+        return -1;
+    }
+
+    if (header->has_board) {
+        *board = initialize_board(header->width, header->height);
+        *player1 = initialize_player_state(header->width, header->height);
+        *player2 = initialize_player_state(header->width, header->height);
+        for (int i = 0; i < header->height; i++) {
+            if (transfer_all(control_fd, (*board)->grid[i], header->width, 0) < 0) {
+                close(control_fd);
+                return -1;
+            }
+        }
+        if (receive_player_state(control_fd, *player1, header->width, header->height) < 0 ||
+            receive_player_state(control_fd, *player2, header->width, header->height) < 0) {
+            close(control_fd);
+            return -1;
+        }
+    }
+
+    return control_fd;
+}
+
+// Tell the old server the match has resumed here, so it can exit
+int confirm_handoff(int control_fd) {
+    uint32_t ack = HANDOFF_RESUMED;
+    int result = transfer_all(control_fd, &ack, sizeof(ack), 1);
+    close(control_fd);
+    return result;
+}
+
 int does_piece_fit(GameBoard *board, TetrisPiece piece) {
+    if (board->is_fast) {
+        int *bounds = shape_bounds[piece.type - 1][piece.rotation - 1];
+        return piece.row + bounds[0] >= 0 && piece.row + bounds[2] < board->height &&
+               piece.column + bounds[1] >= 0 && piece.column + bounds[3] < board->width;
+    }
+
     int (*offsets)[2] = shape_offsets[piece.type - 1][piece.rotation - 1];
 
     for (int i = 0; i < 4; i++) {
@@ -376,7 +947,16 @@ int process_initialize_packet(GameBoard *board, PlayerState *player, char *packe
         }
 
         // Check for overlap only after passing the above validations
-        if (flag==1 && is_piece_overlapping(player, piece)) {
+        if (flag==1 && board->is_fast) {
+            BoardMask occupied = 0;
+            for (int j = 0; j < 5; j++) {
+                if (player->pieces[j].type != 0) occupied |= piece_mask(board, player->pieces[j]);
+            }
+            if (occupied & piece_mask(board, piece)) {
+                printf("[Debug] Overlap detected for piece %d\n", i + 1);
+                return 303; // Pieces overlap
+            }
+        } else if (flag==1 && is_piece_overlapping(player, piece)) {
             printf("Flag is set to true. Can check for overlap now.");
             printf("[Debug] Overlap detected for piece %d\n", i + 1);
             return 303; // Pieces overlap
@@ -417,11 +997,23 @@ int process_shoot_packet(GameBoard *board, PlayerState *target, char *packet, ch
     if (board->grid[row][col] == 'S') { // Hit
         target->hits[row][col] = 'H';
         board->grid[row][col] = 'H';
+        if (board->is_fast) {
+            target->hit_mask |= (BoardMask)1 << (row * board->width + col);
+        }
 
         for (int i = 0; i < 5; i++) {
             TetrisPiece piece = target->pieces[i];
             if (piece.type == 0) continue;
 
+            if (board->is_fast) {
+                BoardMask mask = piece_mask(board, piece);
+                if ((target->hit_mask & mask) == mask) {
+                    target->pieces[i].type = 0; // Mark ship as sunk
+                    target->ships_remaining--;
+                }
+                continue;
+            }
+
             int (*offsets)[2] = shape_offsets[piece.type - 1][piece.rotation - 1];
 
             int piece_cells = 0, hit_cells = 0;
@@ -467,79 +1059,200 @@ void process_query_packet(PlayerState *player, char *response) {
     strcat(response, history);
 }
 
-int main() {
+// Build with -DHW4_NO_MAIN to reuse the game logic from another program (see tournament.c)
+#ifndef HW4_NO_MAIN
+int main(int argc, char **argv) {
     int server_fd1, server_fd2, client_fd1, client_fd2;
+    int unix_fd1, unix_fd2, upgrade_fd;
     struct sockaddr_in address1, address2;
     int opt = 1;
-    socklen_t addrlen = sizeof(struct sockaddr_in);
     char buffer[BUFFER_SIZE];
     int width = 0, height = 0; // Board dimensions
     int player_ready[2] = {0, 0}; // Track readiness of players
+    int next_player = 0; // Player to read from first when resuming a match
 
-    // Create sockets
-    server_fd1 = socket(AF_INET, SOCK_STREAM, 0);
-    server_fd2 = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd1 == 0 || server_fd2 == 0) {
-        perror("[Server] Socket creation failed");
-        exit(EXIT_FAILURE);
-    }
+    PlayerPhase player1_phase = PHASE_BEGIN;
+    PlayerPhase player2_phase = PHASE_BEGIN;
 
-    setsockopt(server_fd1, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    setsockopt(server_fd2, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    // Initialize game board and player states
+    GameBoard *game_board = NULL;
+    PlayerState *player1 = NULL;
+    PlayerState *player2 = NULL;
 
-    // Configure addresses
-    address1.sin_family = AF_INET;
-    address1.sin_addr.s_addr = INADDR_ANY;
-    address1.sin_port = htons(PORT1);
+    if (argc > 1 && strcmp(argv[1], "--takeover") == 0) {
+        // Hot restart: inherit the sockets and match from the running server
+        int fds[HANDOFF_FDS];
+        HandoffHeader header;
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int control_fd = receive_handoff(fds, &header, &game_board, &player1, &player2);
+        if (control_fd < 0) {
+            perror("[Server] Takeover failed");
+            exit(EXIT_FAILURE);
+        }
 
-    address2.sin_family = AF_INET;
-    address2.sin_addr.s_addr = INADDR_ANY;
-    address2.sin_port = htons(PORT2);
+        server_fd1 = fds[0];
+        server_fd2 = fds[1];
+        unix_fd1 = fds[2];
+        unix_fd2 = fds[3];
+        client_fd1 = fds[4];
+        client_fd2 = fds[5];
+        width = header.width;
+        height = header.height;
+        player_ready[0] = header.player_ready[0];
+        player_ready[1] = header.player_ready[1];
+        player1_phase = header.phases[0];
+        player2_phase = header.phases[1];
+        next_player = header.next_player;
+
+        // The segments outlive the old server, so packets already in the rings carry over
+        shm_channels[0] = shm_channel_open(SHM_PATH1, 0);
+        shm_channels[1] = shm_channel_open(SHM_PATH2, 0);
+        if ((header.shm_players[0] && !shm_channels[0]) || (header.shm_players[1] && !shm_channels[1])) {
+            perror("[Server] Shared memory takeover failed");
+            exit(EXIT_FAILURE);
+        }
+        if (header.shm_players[0]) shm_fds[0] = client_fd1;
+        if (header.shm_players[1]) shm_fds[1] = client_fd2;
 
-    // Bind sockets
-    if (bind(server_fd1, (struct sockaddr *)&address1, sizeof(address1)) < 0 ||
-        bind(server_fd2, (struct sockaddr *)&address2, sizeof(address2)) < 0) {
-        perror("[Server] Bind failed");
-        exit(EXIT_FAILURE);
-    }
+        // Until this ack arrives the old server keeps serving; without it we must not
+        if (confirm_handoff(control_fd) < 0) {
+            perror("[Server] Takeover not acknowledged");
+            exit(EXIT_FAILURE);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
 
-    // Listen for connections
-    listen(server_fd1, 3);
-    listen(server_fd2, 3);
+        printf("[Server] Took over match in %ld us.\n",
+               (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
+    } else {
+        // Create sockets
+        server_fd1 = socket(AF_INET, SOCK_STREAM, 0);
+        server_fd2 = socket(AF_INET, SOCK_STREAM, 0);
+        if (server_fd1 == 0 || server_fd2 == 0) {
+            perror("[Server] Socket creation failed");
+            exit(EXIT_FAILURE);
+        }
 
-    printf("[Server] Waiting for Player 1 on port %d\n", PORT1);
-    printf("[Server] Waiting for Player 2 on port %d\n", PORT2);
+        setsockopt(server_fd1, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        setsockopt(server_fd2, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
-    // Accept connections
-    client_fd1 = accept(server_fd1, (struct sockaddr *)&address1, &addrlen);
-    client_fd2 = accept(server_fd2, (struct sockaddr *)&address2, &addrlen);
+        // Configure addresses
+        address1.sin_family = AF_INET;
+        address1.sin_addr.s_addr = INADDR_ANY;
+        address1.sin_port = htons(PORT1);
 
-    if (client_fd1 < 0 || client_fd2 < 0) {
-        perror("[Server] Accept failed");
-        exit(EXIT_FAILURE);
-    }
+        address2.sin_family = AF_INET;
+        address2.sin_addr.s_addr = INADDR_ANY;
+        address2.sin_port = htons(PORT2);
 
+        // Bind sockets
+        if (bind(server_fd1, (struct sockaddr *)&address1, sizeof(address1)) < 0 ||
+            bind(server_fd2, (struct sockaddr *)&address2, sizeof(address2)) < 0) {
+            perror("[Server] Bind failed");
+            exit(EXIT_FAILURE);
+        }
 
-    PlayerPhase player1_phase = PHASE_BEGIN;
-    PlayerPhase player2_phase = PHASE_BEGIN;
+        // Listen for connections
+        listen(server_fd1, 3);
+        listen(server_fd2, 3);
 
-    printf("[Server] Both players connected. Starting game setup...\n");
+        // Co-located players can skip the TCP stack by using the Unix domain sockets
+        unix_fd1 = create_unix_listener(SOCKET_PATH1);
+        unix_fd2 = create_unix_listener(SOCKET_PATH2);
+        if (unix_fd1 < 0 || unix_fd2 < 0) {
+            perror("[Server] Unix socket setup failed");
+            exit(EXIT_FAILURE);
+        }
 
-    // Initialize game board and player states
-    GameBoard *game_board = NULL;
-    PlayerState *player1 = NULL;
-    PlayerState *player2 = NULL;
+        // They can also skip the socket for packets by attaching to a shared-memory segment
+        shm_channels[0] = shm_channel_open(SHM_PATH1, 1);
+        shm_channels[1] = shm_channel_open(SHM_PATH2, 1);
+        if (!shm_channels[0] || !shm_channels[1]) {
+            perror("[Server] Shared memory setup failed");
+            exit(EXIT_FAILURE);
+        }
+
+        printf("[Server] Waiting for Player 1 on port %d or %s\n", PORT1, SOCKET_PATH1);
+        printf("[Server] Waiting for Player 2 on port %d or %s\n", PORT2, SOCKET_PATH2);
+
+        // Accept connections
+        client_fd1 = accept_player(server_fd1, unix_fd1);
+        client_fd2 = accept_player(server_fd2, unix_fd2);
+
+        if (client_fd1 < 0 || client_fd2 < 0) {
+            perror("[Server] Accept failed");
+            exit(EXIT_FAILURE);
+        }
+
+        // Shared-memory clients claim their segment before connecting over the Unix socket
+        if (shm_claimed_by(shm_channels[0], client_fd1)) shm_fds[0] = client_fd1;
+        if (shm_claimed_by(shm_channels[1], client_fd2)) shm_fds[1] = client_fd2;
+
+        printf("[Server] Both players connected. Starting game setup...\n");
+    }
+
+    TRACE_INIT();
+    TRACE_DECLARE(dispatch_start); // Covers everything after the read until the next wait
+    TRACE_DECLARE_PLAYER(dispatch_player);
+
+    // A new server binary can take over this match with "server --takeover"
+    upgrade_fd = create_unix_listener(UPGRADE_PATH);
+    if (upgrade_fd < 0) {
+        perror("[Server] Upgrade socket setup failed");
+        exit(EXIT_FAILURE);
+    }
 
-    
     // Main gameplay loop
     while (1) {
-        for (int i = 0; i < 2; i++) {
+        for (int i = next_player; i < 2; i++) {
             int client_fd = (i == 0) ? client_fd1 : client_fd2;
             PlayerState *opponent = (i == 0) ? player2 : player1;
             PlayerPhase *current_phase = (i == 0) ? &player1_phase : &player2_phase;
+            next_player = 0;
+            TRACE_END(dispatch_start, "dispatch", dispatch_player);
+            TRACE_EXPORT_IF_REQUESTED();
+
+            // Wait for the player's packet, or for a new server to take over
+            int ready = wait_for_packet(client_fd, upgrade_fd);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    i--; // Interrupted by a signal; keep waiting for the same player
+                    continue;
+                }
+                perror("[Server] Waiting for packet failed");
+                remove_server_files();
+                exit(EXIT_FAILURE);
+            }
+            if (ready == 0) {
+                int control_fd = accept(upgrade_fd, NULL, NULL);
+                int handoff_fds[HANDOFF_FDS] = {server_fd1, server_fd2, unix_fd1, unix_fd2,
+                                                client_fd1, client_fd2};
+                HandoffHeader header = {HANDOFF_MAGIC, HANDOFF_FORMAT_VERSION,
+                                        width, height, {player_ready[0], player_ready[1]},
+                                        {player1_phase, player2_phase}, i, game_board != NULL,
+                                        {shm_fds[0] >= 0, shm_fds[1] >= 0}};
+
+                if (control_fd >= 0 &&
+                    send_handoff(control_fd, handoff_fds, &header, game_board, player1, player2) == 0) {
+                    // The new server acked and owns the sockets now; exit without touching them
+                    printf("[Server] Handed match over to new server. Exiting.\n");
+                    exit(0);
+                }
+                perror("[Server] Handoff failed, keeping the match");
+                if (control_fd >= 0) close(control_fd);
+                i--; // Keep waiting for the same player
+                continue;
+            }
 
+            TRACE_PACKET();
+            TRACE_DECLARE(read_start);
+            TRACE_BEGIN(read_start);
             memset(buffer, 0, BUFFER_SIZE);
-            read(client_fd, buffer, BUFFER_SIZE);
+            receive_packet(client_fd, buffer, BUFFER_SIZE);
+            TRACE_END(read_start, "read", i + 1);
+            TRACE_BEGIN(dispatch_start);
+            TRACE_SET_PLAYER(dispatch_player, i + 1);
             printf("[Player %d] Sent: %s\n", i + 1, buffer);
 
             // Handle Forfeit packet first, regardless of phase
@@ -581,7 +1294,10 @@ int main() {
                 }
 
             if (strncmp(buffer, "I", 1) == 0) {
+            TRACE_DECLARE(initialize_start);
+            TRACE_BEGIN(initialize_start);
             int error = process_initialize_packet(game_board, (i == 0) ? player1 : player2, buffer);
+            TRACE_END(initialize_start, "process_initialize_packet", i + 1);
             if (error) {
                 send_error(client_fd, error, i + 1);
             } else {
@@ -598,16 +1314,25 @@ int main() {
             } else if (*current_phase == PHASE_GAMEPLAY) {
                 if (strncmp(buffer, "S", 1) == 0) {
                     char response[BUFFER_SIZE];
+                    TRACE_DECLARE(shoot_start);
+                    TRACE_BEGIN(shoot_start);
                     int error = process_shoot_packet(game_board, opponent, buffer, response);
+                    TRACE_END(shoot_start, "process_shoot_packet", i + 1);
                     if (error) {
                         send_error(client_fd, error, i + 1);
                     } else {
-                        send(client_fd, response, strlen(response), 0);
+                        TRACE_DECLARE(send_start);
+                        TRACE_BEGIN(send_start);
+                        send_packet(client_fd, response);
+                        TRACE_END(send_start, "send", i + 1);
                     }
                 } else if (strncmp(buffer, "Q", 1) == 0) {
                     char response[BUFFER_SIZE];
                     process_query_packet(opponent, response);
-                    send(client_fd, response, strlen(response), 0);
+                    TRACE_DECLARE(send_start);
+                    TRACE_BEGIN(send_start);
+                    send_packet(client_fd, response);
+                    TRACE_END(send_start, "send", i + 1);
                 } else {
                     send_error(client_fd, 102, i + 1); // Invalid packet type
                 }
@@ -624,9 +1349,16 @@ int main() {
     close(client_fd2);
     close(server_fd1);
     close(server_fd2);
+    close(unix_fd1);
+    close(unix_fd2);
+    close(upgrade_fd);
+    unlink(SOCKET_PATH1);
+    unlink(SOCKET_PATH2);
+    unlink(UPGRADE_PATH);
 
     return 0;
 }
+#endif
 
 
 
@@ -4,11 +4,16 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
 #define PORT1 2201
 #define PORT2 2202
+#define SOCKET_PATH1 "/tmp/hw4_player1.sock"
+#define SOCKET_PATH2 "/tmp/hw4_player2.sock"
 #define BUFFER_SIZE 1024
 
+#include "shm_ring.h"
+
 void getInput(char* prompt, char* buffer) {
     printf("%s", prompt);
     fgets(buffer, BUFFER_SIZE, stdin);
@@ -21,33 +26,77 @@ int main(int argc, char **argv) {
     getInput("Which player are you? (1 or 2)", player_number);
     int client_fd = 0;
     struct sockaddr_in serv_addr;
+    struct sockaddr_un unix_addr;
     char buffer[BUFFER_SIZE] = {0};
+    // Pass "-u" after the script to connect over the server's Unix domain socket,
+    // or "-m" to also send packets through the player's shared-memory segment
+    int use_shm = (argc > 2 && strcmp(argv[2], "-m") == 0);
+    int use_unix = use_shm || (argc > 2 && strcmp(argv[2], "-u") == 0);
+    ShmChannel *channel = NULL;
 
-    // Create socket
-    if ((client_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        perror("[Client] socket() failed.");
-        exit(EXIT_FAILURE);
+    if (use_shm) {
+        channel = shm_channel_open(player_number[0]=='1' ? SHM_PATH1 : SHM_PATH2, 0);
+        if (!channel) {
+            perror("[Client] shm_open() failed.");
+            exit(EXIT_FAILURE);
+        }
+        atomic_store(&channel->client_pid, getpid()); // Must be set before connecting
     }
 
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(player_number[0]=='1' ? PORT1 : PORT2);
+    if (use_unix) {
+        // Create socket
+        if ((client_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+            perror("[Client] socket() failed.");
+            exit(EXIT_FAILURE);
+        }
 
-    // Convert IPv4 and IPv6 addresses from text to binary form
-    if (inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr) <= 0) {
-        perror("[Client] Invalid address/ Address not supported.");
-        exit(EXIT_FAILURE);
-    }
+        memset(&unix_addr, 0, sizeof(unix_addr));
+        unix_addr.sun_family = AF_UNIX;
+        strncpy(unix_addr.sun_path, player_number[0]=='1' ? SOCKET_PATH1 : SOCKET_PATH2,
+                sizeof(unix_addr.sun_path) - 1);
+
+        // Connect to server
+        if (connect(client_fd, (struct sockaddr *)&unix_addr, sizeof(unix_addr)) < 0) {
+            perror("[Client] connect() failed.");
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        // Create socket
+        if ((client_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+            perror("[Client] socket() failed.");
+            exit(EXIT_FAILURE);
+        }
+
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_port = htons(player_number[0]=='1' ? PORT1 : PORT2);
 
-    // Connect to server
-    if (connect(client_fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        perror("[Client] connect() failed.");
-        exit(EXIT_FAILURE);
+        // Convert IPv4 and IPv6 addresses from text to binary form
+        if (inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr) <= 0) {
+            perror("[Client] Invalid address/ Address not supported.");
+            exit(EXIT_FAILURE);
+        }
+
+        // Connect to server
+        if (connect(client_fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+            perror("[Client] connect() failed.");
+            exit(EXIT_FAILURE);
+        }
     }
     while (fgets(buffer, sizeof(buffer), fp) != NULL) {
         buffer[strcspn(buffer, "\r\n")] = 0;
-        send(client_fd, buffer, strlen(buffer), 0);
-        memset(buffer, 0, BUFFER_SIZE);
-        int nbytes = read(client_fd, buffer, BUFFER_SIZE);
+        int nbytes;
+        if (channel) {
+            shm_ring_push(&channel->to_server, buffer, strlen(buffer));
+            memset(buffer, 0, BUFFER_SIZE);
+            // Gives up if the server goes away, like a read() on the socket would
+            nbytes = shm_ring_wait_peer(&channel->to_client, client_fd) == 1
+                     ? (int)shm_ring_pop(&channel->to_client, buffer, BUFFER_SIZE - 1) : -1;
+        } else {
+            // The server may already have closed the match; the reply is still queued, so don't die on SIGPIPE
+            send(client_fd, buffer, strlen(buffer), MSG_NOSIGNAL);
+            memset(buffer, 0, BUFFER_SIZE);
+            nbytes = read(client_fd, buffer, BUFFER_SIZE);
+        }
         if (nbytes <= 0) {
             perror("[Client] read() failed.");
             exit(EXIT_FAILURE);
@@ -0,0 +1,171 @@
+// Shared-memory packet transport for players on the same host as the server.
+// Each player gets one segment holding two single-producer single-consumer
+// rings of packets: one towards the server and one back to the client. A reader
+// spins briefly, then sleeps on a futex until the writer wakes it. The player's
+// Unix socket stays open alongside the segment so either side can notice a hangup.
+//
+// Include after defining BUFFER_SIZE.
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#define SHM_PATH1 "/hw4_player1" // Shared-memory segment for co-located Player 1
+#define SHM_PATH2 "/hw4_player2" // Shared-memory segment for co-located Player 2
+#define SHM_RING_SLOTS 16
+#define SHM_SPIN_LIMIT 4096 // Checks of an empty ring before sleeping
+#define SHM_POLL_MS 50 // How often a shared-memory wait checks the peer's socket
+
+typedef struct {
+    uint32_t length;
+    char data[BUFFER_SIZE];
+} ShmSlot;
+
+// Packets travel from a single writer to a single reader
+typedef struct {
+    _Atomic uint32_t head;    // Next slot to write; also the futex word readers sleep on
+    _Atomic uint32_t tail;    // Next slot to read
+    _Atomic uint32_t waiting; // 1 while the reader sleeps on head
+    ShmSlot slots[SHM_RING_SLOTS];
+} ShmRing;
+
+typedef struct {
+    _Atomic uint32_t client_pid; // Claim written by the client before it connects to the Unix socket
+    ShmRing to_server;
+    ShmRing to_client;
+} ShmChannel;
+
+// Map a player's segment, creating and clearing it if create is set
+static inline ShmChannel *shm_channel_open(const char *path, int create) {
+    int fd = shm_open(path, O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (create && ftruncate(fd, sizeof(ShmChannel)) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    ShmChannel *channel = mmap(NULL, sizeof(ShmChannel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return channel == MAP_FAILED ? NULL : channel;
+}
+
+static inline void shm_futex_wake(_Atomic uint32_t *word) {
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+// Copy a packet into the ring, waiting for the reader if it is full
+static inline void shm_ring_push(ShmRing *ring, const char *data, size_t length) {
+    uint32_t head = atomic_load(&ring->head);
+    while (head - atomic_load(&ring->tail) == SHM_RING_SLOTS) {
+        sched_yield(); // Full; the protocol is request/response so this is rare
+    }
+
+    ShmSlot *slot = &ring->slots[head % SHM_RING_SLOTS];
+    slot->length = length < BUFFER_SIZE ? length : BUFFER_SIZE;
+    memcpy(slot->data, data, slot->length);
+    atomic_store(&ring->head, head + 1);
+
+    if (atomic_load(&ring->waiting)) {
+        shm_futex_wake(&ring->head);
+    }
+}
+
+// Wait up to timeout_ms (-1 for ever) for a packet. Returns 1 once one is available,
+// 0 on timeout, and -1 with errno set to EINTR if a signal interrupted the wait.
+static inline int shm_ring_wait(ShmRing *ring, int timeout_ms) {
+    static int spin_limit = -1;
+    if (spin_limit < 0) {
+        // Spinning only helps when the writer can run on another CPU meanwhile
+        spin_limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_SPIN_LIMIT : 0;
+    }
+
+    uint32_t tail = atomic_load(&ring->tail);
+    for (int spin = 0; spin < spin_limit; spin++) {
+        if (atomic_load(&ring->head) != tail) return 1;
+    }
+
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    while (1) {
+        atomic_store(&ring->waiting, 1);
+        uint32_t head = atomic_load(&ring->head);
+        if (head != tail) {
+            atomic_store(&ring->waiting, 0);
+            return 1;
+        }
+
+        long rc = syscall(SYS_futex, (uint32_t *)&ring->head, FUTEX_WAIT, head,
+                          timeout_ms < 0 ? NULL : &timeout, NULL, 0);
+        atomic_store(&ring->waiting, 0);
+        if (atomic_load(&ring->head) != tail) {
+            return 1;
+        }
+        if (rc < 0 && errno == ETIMEDOUT) {
+            return 0;
+        }
+        if (rc < 0 && errno == EINTR) {
+            return -1;
+        }
+    }
+}
+
+// Wait for a packet while watching the peer's socket, which carries no packets once
+// the segment is in use. Returns 1 once a packet is available, or -1 with errno set
+// (ECONNRESET if the peer closed its socket).
+static inline int shm_ring_wait_peer(ShmRing *ring, int peer_fd) {
+    while (1) {
+        if (shm_ring_wait(ring, SHM_POLL_MS) == 1) {
+            return 1;
+        }
+
+        struct pollfd fd = {.fd = peer_fd, .events = POLLIN};
+        if (poll(&fd, 1, 0) < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (!(fd.revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+
+        char byte;
+        ssize_t n = recv(peer_fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EINTR))) {
+            continue; // Not a hangup; keep waiting on the ring
+        }
+        // The peer may have pushed its last packet just before closing
+        if (atomic_load(&ring->head) != atomic_load(&ring->tail)) {
+            return 1;
+        }
+        if (n == 0) errno = ECONNRESET;
+        return -1;
+    }
+}
+
+// Take the next packet without waiting. Returns its length, or 0 if the ring is empty.
+static inline size_t shm_ring_pop(ShmRing *ring, char *buffer, size_t size) {
+    uint32_t tail = atomic_load(&ring->tail);
+    if (atomic_load(&ring->head) == tail) {
+        return 0;
+    }
+
+    ShmSlot *slot = &ring->slots[tail % SHM_RING_SLOTS];
+    size_t length = slot->length < size ? slot->length : size;
+    memcpy(buffer, slot->data, length);
+    atomic_store(&ring->tail, tail + 1);
+    return length;
+}
+
+#endif
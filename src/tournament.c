@@ -0,0 +1,479 @@
+// Bot-vs-bot tournament runner. Plays matches in-process using the server's
+// game logic, spread across a pool of forked workers.
+//
+// Build: gcc -O2 -o tournament tournament.c -lm
+// Usage: ./tournament [-w workers] [-n games_per_pairing] [-s swiss_rounds] [-r seed]
+//        Round robin by default; -s runs that many Swiss rounds instead.
+#define HW4_NO_MAIN
+#include "hw4.c"
+
+#include <fcntl.h>
+#include <math.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define BOARD_WIDTH 10
+#define BOARD_HEIGHT 10
+#define MAX_TURNS (2 * BOARD_WIDTH * BOARD_HEIGHT) // Each player can shoot every cell once
+#define MAX_PLACEMENT_TRIES 1000
+#define ELO_START 1500.0
+#define ELO_K 32.0
+
+// What a bot knows about the opponent's board
+typedef struct {
+    unsigned int seed;              // Per-bot random state
+    int cursor;                     // Next cell for sweeping strategies
+    char seen[BOARD_HEIGHT][BOARD_WIDTH]; // 'E' untried, 'H' hit, 'M' miss
+    int stack[BOARD_WIDTH * BOARD_HEIGHT]; // Cells queued for the hunt strategy
+    int stack_size;
+} BotState;
+
+typedef struct {
+    const char *name;
+    void (*shoot)(BotState *bot, int *row, int *col);
+} Strategy;
+
+// One match to play: index into the strategy table for each player
+typedef struct {
+    int player1;
+    int player2;
+    unsigned int seed;
+} Match;
+
+// Result of one match, sent back from a worker
+typedef struct {
+    int match;
+    int winner; // 1 or 2, 0 for a draw
+    int turns;
+} MatchResult;
+
+// Shoot at the next untried cell in row-major order
+void shoot_scan(BotState *bot, int *row, int *col) {
+    while (bot->seen[bot->cursor / BOARD_WIDTH][bot->cursor % BOARD_WIDTH] != 'E') {
+        bot->cursor++;
+    }
+    *row = bot->cursor / BOARD_WIDTH;
+    *col = bot->cursor % BOARD_WIDTH;
+}
+
+// Shoot at a random untried cell
+void shoot_random(BotState *bot, int *row, int *col) {
+    do {
+        *row = rand_r(&bot->seed) % BOARD_HEIGHT;
+        *col = rand_r(&bot->seed) % BOARD_WIDTH;
+    } while (bot->seen[*row][*col] != 'E');
+}
+
+// Sweep one colour of a checkerboard first; every piece covers both colours
+void shoot_parity(BotState *bot, int *row, int *col) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (int cell = 0; cell < BOARD_WIDTH * BOARD_HEIGHT; cell++) {
+            int r = cell / BOARD_WIDTH, c = cell % BOARD_WIDTH;
+            if ((r + c) % 2 == pass && bot->seen[r][c] == 'E') {
+                *row = r;
+                *col = c;
+                return;
+            }
+        }
+    }
+}
+
+// Shoot randomly until a hit, then work through the neighbours of each hit
+void shoot_hunt(BotState *bot, int *row, int *col) {
+    while (bot->stack_size > 0) {
+        int cell = bot->stack[--bot->stack_size];
+        if (bot->seen[cell / BOARD_WIDTH][cell % BOARD_WIDTH] == 'E') {
+            *row = cell / BOARD_WIDTH;
+            *col = cell % BOARD_WIDTH;
+            return;
+        }
+    }
+    shoot_random(bot, row, col);
+}
+
+Strategy strategies[] = {
+    {"scan", shoot_scan},
+    {"random", shoot_random},
+    {"parity", shoot_parity},
+    {"hunt", shoot_hunt},
+};
+#define STRATEGY_COUNT ((int)(sizeof(strategies) / sizeof(strategies[0])))
+
+// Record the outcome of a shot in the bot's view of the opponent board
+void observe_shot(BotState *bot, int row, int col, int hit) {
+    bot->seen[row][col] = hit ? 'H' : 'M';
+    if (!hit) return;
+
+    int neighbours[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    for (int i = 0; i < 4; i++) {
+        int r = row + neighbours[i][0], c = col + neighbours[i][1];
+        if (r >= 0 && r < BOARD_HEIGHT && c >= 0 && c < BOARD_WIDTH && bot->seen[r][c] == 'E') {
+            bot->stack[bot->stack_size++] = r * BOARD_WIDTH + c;
+        }
+    }
+}
+
+// Reset a board and player so they can be reused for the next match
+void reset_match_state(GameBoard *board, PlayerState *player) {
+    for (int i = 0; i < board->height; i++) {
+        memset(board->grid[i], 'E', board->width);
+        memset(player->hits[i], 'E', board->width);
+    }
+    player->is_ready = 0;
+    player->ships_remaining = 5;
+    memset(player->pieces, 0, sizeof(player->pieces));
+    player->hit_mask = 0;
+}
+
+// Place five random pieces through the server's Initialize validation
+int place_pieces(GameBoard *board, PlayerState *player, BotState *bot) {
+    char packet[BUFFER_SIZE];
+
+    for (int attempt = 0; attempt < MAX_PLACEMENT_TRIES; attempt++) {
+        int length = snprintf(packet, BUFFER_SIZE, "I");
+        for (int i = 0; i < 5; i++) {
+            length += snprintf(packet + length, BUFFER_SIZE - length, " %d %d %d %d",
+                               rand_r(&bot->seed) % 7 + 1, rand_r(&bot->seed) % 4 + 1,
+                               rand_r(&bot->seed) % BOARD_WIDTH, rand_r(&bot->seed) % BOARD_HEIGHT);
+        }
+
+        memset(player->pieces, 0, sizeof(player->pieces));
+        if (process_initialize_packet(board, player, packet) == 0) {
+            // Mark the ships on the board so shots can hit them
+            for (int i = 0; i < 5; i++) {
+                TetrisPiece piece = player->pieces[i];
+                int (*offsets)[2] = shape_offsets[piece.type - 1][piece.rotation - 1];
+                for (int j = 0; j < 4; j++) {
+                    board->grid[piece.row + offsets[j][0]][piece.column + offsets[j][1]] = 'S';
+                }
+            }
+            return 0;
+        }
+    }
+
+    return -1; // Could not find a valid placement
+}
+
+// Play one match on pre-allocated boards and player states
+MatchResult play_match(Match match, GameBoard *boards[2], PlayerState *players[2]) {
+    MatchResult result = {0, 0, 0};
+    BotState bots[2];
+    Strategy *strategy[2] = {&strategies[match.player1], &strategies[match.player2]};
+    char packet[BUFFER_SIZE], response[BUFFER_SIZE];
+
+    for (int i = 0; i < 2; i++) {
+        reset_match_state(boards[i], players[i]);
+        memset(&bots[i], 0, sizeof(BotState));
+        memset(bots[i].seen, 'E', sizeof(bots[i].seen));
+        bots[i].seed = match.seed * 2 + i;
+        if (place_pieces(boards[i], players[i], &bots[i]) != 0) {
+            result.winner = 2 - i; // A bot that cannot place forfeits
+            return result;
+        }
+    }
+
+    for (int turn = 0; turn < MAX_TURNS; turn++) {
+        int shooter = turn % 2, target = 1 - shooter;
+        int row, col;
+
+        strategy[shooter]->shoot(&bots[shooter], &row, &col);
+        snprintf(packet, BUFFER_SIZE, "S %d %d", row, col);
+        if (process_shoot_packet(boards[target], players[target], packet, response) != 0) {
+            result.winner = target + 1; // An invalid shot forfeits the match
+            result.turns = turn + 1;
+            return result;
+        }
+
+        observe_shot(&bots[shooter], row, col, response[strlen(response) - 1] == 'H');
+        if (players[target]->ships_remaining == 0) {
+            result.winner = shooter + 1;
+            result.turns = turn + 1;
+            return result;
+        }
+    }
+
+    result.turns = MAX_TURNS;
+    return result; // Draw
+}
+
+// Play every match in the batch across the worker pool
+void run_batch(Match *matches, int match_count, MatchResult *results, int workers) {
+    int pipes[2];
+    if (pipe(pipes) < 0) {
+        perror("[Tournament] pipe() failed");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int w = 0; w < workers; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("[Tournament] fork() failed");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            close(pipes[0]);
+            // The game logic logs every packet; keep workers quiet
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+
+            // Each worker keeps its boards warm across all of its matches
+            GameBoard *boards[2] = {initialize_board(BOARD_WIDTH, BOARD_HEIGHT),
+                                    initialize_board(BOARD_WIDTH, BOARD_HEIGHT)};
+            PlayerState *players[2] = {initialize_player_state(BOARD_WIDTH, BOARD_HEIGHT),
+                                       initialize_player_state(BOARD_WIDTH, BOARD_HEIGHT)};
+
+            for (int m = w; m < match_count; m += workers) {
+                MatchResult result = play_match(matches[m], boards, players);
+                result.match = m;
+                if (write(pipes[1], &result, sizeof(result)) != sizeof(result)) {
+                    _exit(EXIT_FAILURE);
+                }
+            }
+            _exit(0);
+        }
+    }
+
+    close(pipes[1]);
+    MatchResult result;
+    int received = 0;
+    while (read(pipes[0], &result, sizeof(result)) == sizeof(result)) {
+        results[result.match] = result;
+        received++;
+    }
+    close(pipes[0]);
+    while (wait(NULL) > 0);
+
+    if (received != match_count) {
+        fprintf(stderr, "[Tournament] Only %d of %d matches completed.\n", received, match_count);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Per-strategy standings
+typedef struct {
+    double elo;
+    int wins;
+    int losses;
+    int draws;
+    int byes;                // Swiss rounds sat out, each scored as a win
+    int met[STRATEGY_COUNT]; // Swiss rounds played against each strategy
+} Standing;
+
+// Tally results and update Elo. Matches come in rounds of round_size games, and every
+// game in a round is rated against the ratings the round started with, so the result
+// does not depend on the order of games within a round.
+void record_results(Match *matches, MatchResult *results, int match_count, int round_size, Standing *standings) {
+    for (int start = 0; start < match_count; start += round_size) {
+        double delta[STRATEGY_COUNT] = {0};
+        int end = start + round_size < match_count ? start + round_size : match_count;
+
+        for (int m = start; m < end; m++) {
+            Standing *a = &standings[matches[m].player1];
+            Standing *b = &standings[matches[m].player2];
+            double score = results[m].winner == 1 ? 1.0 : results[m].winner == 2 ? 0.0 : 0.5;
+            double expected = 1.0 / (1.0 + pow(10.0, (b->elo - a->elo) / 400.0));
+
+            delta[matches[m].player1] += ELO_K * (score - expected);
+            delta[matches[m].player2] -= ELO_K * (score - expected);
+
+            if (results[m].winner == 1) {
+                a->wins++;
+                b->losses++;
+            } else if (results[m].winner == 2) {
+                b->wins++;
+                a->losses++;
+            } else {
+                a->draws++;
+                b->draws++;
+            }
+        }
+
+        for (int i = 0; i < STRATEGY_COUNT; i++) {
+            standings[i].elo += delta[i];
+        }
+    }
+}
+
+// Swiss points: a win or a bye is worth 1, a draw 0.5
+double standing_points(Standing *standing) {
+    return standing->wins + standing->byes + 0.5 * standing->draws;
+}
+
+// Whether strategy a ranks above b: points, then Elo, then a per-round random key
+int ranks_above(Standing *standings, unsigned int *keys, int a, int b) {
+    double points_a = standing_points(&standings[a]);
+    double points_b = standing_points(&standings[b]);
+    if (points_a != points_b) return points_a > points_b;
+    if (standings[a].elo != standings[b].elo) return standings[a].elo > standings[b].elo;
+    return keys[a] > keys[b];
+}
+
+// Pair the highest unpaired entry of order[] with the closest-ranked unpaired entry below
+// it, backtracking when the rest cannot be paired. Rematches are only taken if allowed.
+// An entry whose partner is itself has the bye. Returns 1 once everyone is placed.
+int pair_from(Standing *standings, int *order, int *partner, int allow_rematch) {
+    int first = 0;
+    while (first < STRATEGY_COUNT && partner[first] >= 0) first++;
+    if (first == STRATEGY_COUNT) {
+        return 1;
+    }
+
+    for (int j = first + 1; j < STRATEGY_COUNT; j++) {
+        if (partner[j] >= 0) continue;
+        if (!allow_rematch && standings[order[first]].met[order[j]]) continue;
+
+        partner[first] = j;
+        partner[j] = first;
+        if (pair_from(standings, order, partner, allow_rematch)) {
+            return 1;
+        }
+        partner[first] = -1;
+        partner[j] = -1;
+    }
+    return 0;
+}
+
+// Pair strategies within their score groups (Swiss system), avoiding rematches while
+// any rematch-free pairing exists. With an odd count one strategy gets a bye, going
+// to those with the fewest byes first. Games are laid out one round of pairings at a time.
+int build_swiss_round(Standing *standings, Match *matches, int games, unsigned int seed) {
+    int order[STRATEGY_COUNT];
+    unsigned int keys[STRATEGY_COUNT];
+    for (int i = 0; i < STRATEGY_COUNT; i++) {
+        order[i] = i;
+        keys[i] = rand_r(&seed);
+    }
+
+    // Sort by rank, highest first
+    for (int i = 1; i < STRATEGY_COUNT; i++) {
+        int current = order[i], j = i - 1;
+        while (j >= 0 && ranks_above(standings, keys, current, order[j])) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = current;
+    }
+
+    // Bye candidates by position in order[]: fewest byes first, then lowest ranked
+    int bye_order[STRATEGY_COUNT];
+    int bye_count = STRATEGY_COUNT % 2 ? STRATEGY_COUNT : 1;
+    for (int i = 0; i < STRATEGY_COUNT; i++) {
+        int current = STRATEGY_COUNT - 1 - i, j = i - 1;
+        while (j >= 0 && standings[order[current]].byes < standings[order[bye_order[j]]].byes) {
+            bye_order[j + 1] = bye_order[j];
+            j--;
+        }
+        bye_order[j + 1] = current;
+    }
+
+    int partner[STRATEGY_COUNT], paired = 0;
+    for (int allow_rematch = 0; allow_rematch <= 1 && !paired; allow_rematch++) {
+        for (int candidate = 0; candidate < bye_count && !paired; candidate++) {
+            for (int i = 0; i < STRATEGY_COUNT; i++) partner[i] = -1;
+            if (STRATEGY_COUNT % 2) {
+                partner[bye_order[candidate]] = bye_order[candidate];
+            }
+            paired = pair_from(standings, order, partner, allow_rematch);
+        }
+    }
+
+    int count = 0;
+    for (int g = 0; g < games; g++) {
+        for (int i = 0; i < STRATEGY_COUNT; i++) {
+            if (partner[i] <= i) continue; // Listed once per pairing; the bye plays nobody
+            // Alternate who moves first
+            int first = (g % 2 == 0) ? order[i] : order[partner[i]];
+            int second = (g % 2 == 0) ? order[partner[i]] : order[i];
+            matches[count] = (Match){first, second, seed + count};
+            count++;
+        }
+    }
+
+    for (int i = 0; i < STRATEGY_COUNT; i++) {
+        if (partner[i] > i) {
+            standings[order[i]].met[order[partner[i]]]++;
+            standings[order[partner[i]]].met[order[i]]++;
+        } else if (partner[i] == i) {
+            standings[order[i]].byes++;
+        }
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    int workers = 4, games = 100, swiss_rounds = 0;
+    unsigned int seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:n:s:r:")) != -1) {
+        switch (opt) {
+            case 'w': workers = atoi(optarg); break;
+            case 'n': games = atoi(optarg); break;
+            case 's': swiss_rounds = atoi(optarg); break;
+            case 'r': seed = (unsigned int)atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-w workers] [-n games_per_pairing] [-s swiss_rounds] [-r seed]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (workers < 1 || games < 1 || swiss_rounds < 0) {
+        fprintf(stderr, "[Tournament] Workers and games must be positive.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    Standing standings[STRATEGY_COUNT];
+    for (int i = 0; i < STRATEGY_COUNT; i++) {
+        standings[i] = (Standing){.elo = ELO_START};
+    }
+
+    int max_matches = STRATEGY_COUNT * STRATEGY_COUNT * games;
+    Match *matches = malloc(max_matches * sizeof(Match));
+    MatchResult *results = malloc(max_matches * sizeof(MatchResult));
+    int total_matches = 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (swiss_rounds == 0) {
+        // Round robin: every ordered pair, so each bot shoots first equally often.
+        // Each round holds one game of every pairing.
+        int count = 0, round_size = STRATEGY_COUNT * (STRATEGY_COUNT - 1);
+        for (int g = 0; g < games; g++) {
+            for (int a = 0; a < STRATEGY_COUNT; a++) {
+                for (int b = 0; b < STRATEGY_COUNT; b++) {
+                    if (a == b) continue;
+                    matches[count] = (Match){a, b, seed + count};
+                    count++;
+                }
+            }
+        }
+        run_batch(matches, count, results, workers);
+        record_results(matches, results, count, round_size, standings);
+        total_matches = count;
+    } else {
+        for (int round = 0; round < swiss_rounds; round++) {
+            int count = build_swiss_round(standings, matches, games, seed + total_matches);
+            run_batch(matches, count, results, workers);
+            record_results(matches, results, count, count / games, standings);
+            total_matches += count;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("%-10s %8s %6s %6s %6s %6s %9s\n", "Strategy", "Elo", "Wins", "Losses", "Draws", "Byes", "Win rate");
+    for (int i = 0; i < STRATEGY_COUNT; i++) {
+        Standing *s = &standings[i];
+        int played = s->wins + s->losses + s->draws;
+        printf("%-10s %8.1f %6d %6d %6d %6d %8.1f%%\n", strategies[i].name, s->elo,
+               s->wins, s->losses, s->draws, s->byes, played ? 100.0 * s->wins / played : 0.0);
+    }
+    printf("[Tournament] %d matches on %d workers in %.3f s (%.0f matches/sec)\n",
+           total_matches, workers, elapsed, elapsed > 0 ? total_matches / elapsed : 0.0);
+
+    free(matches);
+    free(results);
+    return 0;
+}
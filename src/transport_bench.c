@@ -0,0 +1,122 @@
+// Round-trip latency of the server's transports. Connects as both players over
+// TCP loopback, the Unix domain sockets or shared memory, then times packet/response pairs.
+//
+// Build: gcc -O2 -o transport_bench transport_bench.c
+// Usage: ./server > /dev/null & ./transport_bench <tcp|unix|shm> [round_trips]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define PORT1 2201
+#define PORT2 2202
+#define SOCKET_PATH1 "/tmp/hw4_player1.sock"
+#define SOCKET_PATH2 "/tmp/hw4_player2.sock"
+#define BUFFER_SIZE 1024
+
+#include "shm_ring.h"
+
+typedef struct {
+    int fd;
+    ShmChannel *channel; // NULL unless using shared memory
+} Connection;
+
+Connection connect_player(const char *transport, int player) {
+    Connection connection = {-1, NULL};
+
+    if (strcmp(transport, "tcp") == 0) {
+        struct sockaddr_in address = {0};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(player == 1 ? PORT1 : PORT2);
+        inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        connection.fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(connection.fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            perror("[Bench] connect() failed");
+            exit(EXIT_FAILURE);
+        }
+        return connection;
+    }
+
+    if (strcmp(transport, "shm") == 0) {
+        connection.channel = shm_channel_open(player == 1 ? SHM_PATH1 : SHM_PATH2, 0);
+        if (!connection.channel) {
+            perror("[Bench] shm_open() failed");
+            exit(EXIT_FAILURE);
+        }
+        atomic_store(&connection.channel->client_pid, getpid()); // Must be set before connecting
+    } else if (strcmp(transport, "unix") != 0) {
+        fprintf(stderr, "[Bench] Unknown transport %s\n", transport);
+        exit(EXIT_FAILURE);
+    }
+
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, player == 1 ? SOCKET_PATH1 : SOCKET_PATH2, sizeof(address.sun_path) - 1);
+    connection.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(connection.fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("[Bench] connect() failed");
+        exit(EXIT_FAILURE);
+    }
+    return connection;
+}
+
+// Send a packet and wait for the server's response
+void round_trip(Connection *connection, const char *packet, char *response) {
+    memset(response, 0, BUFFER_SIZE);
+    if (connection->channel) {
+        shm_ring_push(&connection->channel->to_server, packet, strlen(packet));
+        if (shm_ring_wait_peer(&connection->channel->to_client, connection->fd) != 1) {
+            perror("[Bench] Server closed the connection");
+            exit(EXIT_FAILURE);
+        }
+        shm_ring_pop(&connection->channel->to_client, response, BUFFER_SIZE - 1);
+    } else {
+        send(connection->fd, packet, strlen(packet), MSG_NOSIGNAL);
+        if (read(connection->fd, response, BUFFER_SIZE - 1) <= 0) {
+            fprintf(stderr, "[Bench] Server closed the connection.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <tcp|unix|shm> [round_trips]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    int count = argc > 2 ? atoi(argv[2]) : 20000;
+    if (count < 2) count = 2;
+
+    char response[BUFFER_SIZE];
+    Connection players[2] = {connect_player(argv[1], 1), connect_player(argv[1], 2)};
+    round_trip(&players[0], "B 10 10", response);
+    round_trip(&players[1], "B", response);
+
+    // Every packet gets exactly one response, so an invalid one is a cheap ping
+    double *latencies = malloc(count * sizeof(double));
+    for (int n = 0; n < count; n++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        round_trip(&players[n % 2], "Q", response);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        latencies[n] = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+    }
+    round_trip(&players[count % 2], "F", response);
+
+    double total = 0;
+    for (int n = 0; n < count; n++) total += latencies[n];
+    qsort(latencies, count, sizeof(double), compare_doubles);
+    printf("%-5s %d round trips: mean %.2f us, p50 %.2f us, p99 %.2f us\n", argv[1], count,
+           total / count, latencies[count / 2], latencies[count * 99 / 100]);
+
+    free(latencies);
+    return 0;
+}